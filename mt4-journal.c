@@ -0,0 +1,102 @@
+//+------------------------------------------------------------------+
+//|                                                  mt4-journal.mq4 |
+//|                        Copyright 2021, MetaQuotes Software Corp. |
+//|                                             https://www.mql5.com |
+//+------------------------------------------------------------------+
+#property strict
+#property script_show_inputs
+
+/*
+回放日志读取脚本
+
+ 马丁EA实盘时写的回放日志(Common\Files\matin-journal-*.bin、matin-double-journal-*.bin)，格式见mt4-journal.mqh
+
+ JOURNAL_MODE 0: 汇总，打印tick数、被跳过的tick、下单平仓的成功失败和耗时、休眠和轮次变化
+ JOURNAL_MODE 1: 导出CSV到Files目录，一条记录一行，按时间看出事前后发生了什么
+
+ 重现：把EA挂到回测里，品种、参数、EA_ID和写日志时一样，REPLAY_JOURNAL填日志文件名。
+ EA不用回测的行情，按日志一个tick一个tick重跑，随机数用日志里的种子；跑出来的下单、平仓、
+ 休眠、轮次和日志对不上时，日志里会打印在第几条记录分叉
+ **/
+
+#include "mt4-journal.mqh"
+
+input int JOURNAL_MODE = 0; // 0:汇总 1:导出CSV
+input string JOURNAL_FILE = ""; // Common\Files里的日志文件名
+input string CSV_FILE = "journal.csv"; // 导出到Files目录
+
+void OnStart()
+  {
+   JournalHeader header;
+   if(!JournalOpenRead(JOURNAL_FILE, header)) return;
+   Print(JOURNAL_FILE, ": ", CharArrayToString(header.symbol), ", dirs=", header.dirs, ", EA_ID=", header.eaId, ", seed=", header.seed,
+     ", started at ", TimeToStr(header.startTime, TIME_DATE | TIME_SECONDS), ", params=", CharArrayToString(header.params));
+   if(JOURNAL_MODE == 0) {
+     Summarize();
+   } else if(JOURNAL_MODE == 1) {
+     ExportCsv(CSV_FILE);
+   }
+   JournalCloseRead();
+  }
+
+void Summarize() {
+   ulong kinds[JR_KINDS];
+   ArrayInitialize(kinds, 0);
+   ulong held = 0;
+   int sendFailed = 0;
+   int closeFailed = 0;
+   ulong sendMicros = 0;
+   ulong sendMax = 0;
+   ulong closeMicros = 0;
+   ulong closeMax = 0;
+   datetime first = 0;
+   datetime last = 0;
+   JournalRecord rec;
+   while(JournalNext(rec)) {
+     if(rec.kind <= 0 || rec.kind >= JR_KINDS) {
+       Print("bad record ", jrReadTotal, ": ", JournalText(rec));
+       break;
+     }
+     kinds[rec.kind] ++;
+     if(rec.kind == JR_TICK) {
+       if(first == 0) first = rec.time;
+       last = rec.time;
+       if(rec.a != 0) held ++;
+     } else if(rec.kind == JR_SEND) {
+       if(rec.a < 0) sendFailed ++;
+       sendMicros += rec.micros;
+       if(rec.micros > sendMax) sendMax = rec.micros;
+       if(rec.a < 0) Print("send failed at ", TimeToStr(rec.time, TIME_DATE | TIME_SECONDS), ": type=", rec.b, ", magic=", rec.c, ", error=", rec.d, ", attempts=", rec.e);
+     } else if(rec.kind == JR_CLOSE) {
+       if(rec.b == 0) closeFailed ++;
+       closeMicros += rec.micros;
+       if(rec.micros > closeMax) closeMax = rec.micros;
+       if(rec.b == 0) Print("close failed at ", TimeToStr(rec.time, TIME_DATE | TIME_SECONDS), ": #", rec.a, ", error=", rec.c);
+     } else if(rec.kind == JR_SLEEP || rec.kind == JR_CYCLE) {
+       Print(JournalText(rec));
+     }
+   }
+   Print("records=", jrReadTotal, ", ticks=", kinds[JR_TICK], " (", held, " held by the gate), ", TimeToStr(first, TIME_DATE | TIME_SECONDS), " - ", TimeToStr(last, TIME_DATE | TIME_SECONDS));
+   Print("snapshots=", kinds[JR_SNAP], ", history orders=", kinds[JR_HIST], ", sleeps=", kinds[JR_SLEEP], ", cycles=", kinds[JR_CYCLE]);
+   Print("sends=", kinds[JR_SEND], " (", sendFailed, " failed), avg ", kinds[JR_SEND] > 0 ? DoubleToStr((double)sendMicros / kinds[JR_SEND] / 1000, 1) : "0", "ms, max ", DoubleToStr(sendMax / 1000.0, 1), "ms");
+   Print("closes=", kinds[JR_CLOSE], " (", closeFailed, " failed), avg ", kinds[JR_CLOSE] > 0 ? DoubleToStr((double)closeMicros / kinds[JR_CLOSE] / 1000, 1) : "0", "ms, max ", DoubleToStr(closeMax / 1000.0, 1), "ms");
+}
+
+void ExportCsv(string file) {
+   int handle = FileOpen(file, FILE_WRITE | FILE_TXT | FILE_ANSI);
+   if(handle == INVALID_HANDLE) {
+     Print("open ", file, " failed, error=", GetLastError());
+     return;
+   }
+   FileWriteString(handle, "kind,time,a,b,c,d,e,micros,x,y,z,w\r\n");
+   JournalRecord rec;
+   while(JournalNext(rec)) {
+     FileWriteString(handle, JournalText(rec) + "\r\n");
+   }
+   FileClose(handle);
+   Print(IntegerToString(jrReadTotal), " records written to ", file);
+}
+
+void Log(string text) {
+   Print(text);
+}
@@ -0,0 +1,267 @@
+//+------------------------------------------------------------------+
+//|                                              mt4-liyingguang.mq4 |
+//|                        Copyright 2021, MetaQuotes Software Corp. |
+//|                                             https://www.mql5.com |
+//+------------------------------------------------------------------+
+#property strict
+//+------------------------------------------------------------------+
+//| 规模测试：在回测账户里造持仓和历史单，测马丁各环节随单数增长的耗时 |
+//+------------------------------------------------------------------+
+
+/*
+ 用法：挂到回测里(任意品种、任意时间段，只用第一个tick)，跑完自己退出，结果追加到Common\Files\BENCH_FILE
+ 测双向的在include前面加 #define MATIN_DUAL
+
+ 回测账户就是订单池：按BENCH_HISTORY_SIZES从小到大，开了马上平，把历史单造到每一档；
+ 每一档历史单下再按BENCH_OPEN_SIZES开持仓，然后直接调引擎里的函数计时：
+  snapshot        BuildOrderSnapshot，扫一遍持仓(回测里没有账户快照总线，就是OrderSelect整个持仓)
+  orders          CheckOrders，按快照算浮盈、加仓表、首单对冲。测的时候isSleeping置true、historyProfit清零，不会加仓也不会平首单
+  history         CheckHistoryOrders，没有新平仓的单，每个tick的常态
+  historyNew      CheckHistoryOrders，刚平了BENCH_BATCH单，造历史单时每批测一次
+  historyRebuild  CheckHistoryOrders，历史单对不上号整体重算(回测里没有轮次索引，就是从头扫)
+  close           CloseBasket(CLOSE_ALL)，把本档持仓全部平掉
+ CSV一行一个环节：label,dirs,history,open,routine,calls,items,avgUs,p50Us,p99Us,maxUs,itemsPerSec
+ items是一次调用处理的单数，BENCH_LABEL填版本号，不同提交的结果追加在同一个文件里对比
+
+ 单子的样子：历史单每BENCH_CYCLE_ORDERS单一轮，第一单是开始标识单，后面按层数递增；持仓和实盘一样每个方向只有当前一轮
+ (也是开始标识单加按层数递增的单)，不然CheckOrders每遇到换方向的一轮就重建一次加仓表，测出来的不是实盘会有的样子；
+ BENCH_LEGACY_PCT的EA单是升级前的老单(magic=0，按comment认)，BENCH_OTHER_PCT是手动单和其他EA的单。
+ 手数都用MINI_LOT，回测默认的资金也能开几百单
+ **/
+
+#define MATIN_BENCH
+#include "mt4-matin-engine.mqh"
+
+input string BENCH_HISTORY_SIZES = "1000,10000,100000"; // 历史单数量的几档，逗号分隔
+input string BENCH_OPEN_SIZES = "5,50,200"; // 持仓数量的几档，逗号分隔
+input int BENCH_CYCLE_ORDERS = 10; // 每轮几单(含开始标识单)
+input int BENCH_LEGACY_PCT = 0; // EA单里多少%是magic=0的老单
+input int BENCH_OTHER_PCT = 10; // 多少%是手动单和其他EA的单
+input int BENCH_REPEAT = 200; // 每个环节测多少次
+input int BENCH_REBUILD_REPEAT = 3; // 整体重算测多少次，历史单多的时候很慢
+input int BENCH_BATCH = 100; // 造历史单时每批开平多少单
+input string BENCH_LABEL = ""; // 写进结果，区分版本
+input string BENCH_FILE = MATIN_BENCH_FILE; // 追加到这个文件(Common\Files)
+
+bool benchDone = false;
+int benchHandle = INVALID_HANDLE;
+int benchSeq = 0; // 造到第几单，决定轮次和层数
+int benchTickets[];
+int benchTicketTotal = 0;
+double benchSamples[]; // 本环节每次调用的耗时(us)
+int benchSampleTotal = 0;
+
+void RunBench() {
+   if(benchDone) return;
+   benchDone = true;
+   if(!IsTesting()) {
+     Print("mt4-matin-bench only runs in the strategy tester");
+     ExpertRemove();
+     return;
+   }
+   int historySizes[];
+   int openSizes[];
+   ParseSizes(BENCH_HISTORY_SIZES, historySizes);
+   ParseSizes(BENCH_OPEN_SIZES, openSizes);
+   benchHandle = FileOpen(BENCH_FILE, FILE_READ | FILE_WRITE | FILE_TXT | FILE_ANSI | FILE_COMMON | FILE_SHARE_READ | FILE_SHARE_WRITE);
+   if(benchHandle == INVALID_HANDLE) {
+     Print("open ", BENCH_FILE, " failed, error=", GetLastError());
+     ExpertRemove();
+     return;
+   }
+   if(FileSize(benchHandle) == 0) {
+     FileWriteString(benchHandle, "label,dirs,history,open,routine,calls,items,avgUs,p50Us,p99Us,maxUs,itemsPerSec\r\n");
+   }
+   FileSeek(benchHandle, 0, SEEK_END);
+   MathSrand(randomSeed);
+   ulong startMicros = GetMicrosecondCount();
+   bool ok = true;
+   for(int h = 0; h < ArraySize(historySizes) && ok; h ++) {
+     ok = GrowHistory(historySizes[h]);
+     for(int o = 0; o < ArraySize(openSizes) && ok; o ++) {
+       ok = MeasureOpen(openSizes[o]);
+     }
+   }
+   FileClose(benchHandle);
+   benchHandle = INVALID_HANDLE;
+   Print("bench ", (ok ? "finished" : "stopped"), ": history=", OrdersHistoryTotal(), ", seed=", randomSeed, ", ",
+     DoubleToStr((GetMicrosecondCount() - startMicros) / 1000000.0, 1), "s, results in ", BENCH_FILE);
+   ExpertRemove();
+}
+
+// 开了马上平，直到历史单有target条。每批平完测一次增量统计
+bool GrowHistory(int target) {
+   CaptureTick();
+   BenchReset();
+   int batch = MathMax(BENCH_BATCH, 1);
+   while(OrdersHistoryTotal() < target) {
+     int n = MathMin(batch, target - OrdersHistoryTotal());
+     if(!OpenBenchOrders(n, false)) return false;
+     for(int i = 0; i < benchTicketTotal; i ++) {
+       if(!OrderSelect(benchTickets[i], SELECT_BY_TICKET)) continue;
+       if(!OrderClose(OrderTicket(), OrderLots(), OrderType() == OP_BUY ? Bid : Ask, 3)) {
+         Print("bench close #", OrderTicket(), " failed, error=", GetLastError());
+         return false;
+       }
+     }
+     ulong t = GetMicrosecondCount();
+     CheckHistoryOrders();
+     BenchAdd(GetMicrosecondCount() - t);
+   }
+   BenchWrite("historyNew", OrdersHistoryTotal(), 0, batch);
+   return true;
+}
+
+// 开open单持仓，各环节计时，最后平掉
+bool MeasureOpen(int open) {
+   if(!OpenBenchOrders(open, true)) return false;
+   CheckHistoryOrders(); // 先统计完，下面测的是常态
+   CaptureTick();
+   int history = OrdersHistoryTotal();
+   int repeat = MathMax(BENCH_REPEAT, 1);
+
+   BenchReset();
+   for(int r = 0; r < repeat; r ++) {
+     ulong t = GetMicrosecondCount();
+     BuildOrderSnapshot();
+     BenchAdd(GetMicrosecondCount() - t);
+   }
+   BenchWrite("snapshot", history, open, snapTotal);
+
+   bool sleeping = isSleeping;
+   double profit[MATIN_DIRS];
+   ArrayCopy(profit, historyProfit);
+   isSleeping = true;
+   BenchReset();
+   for(int r = 0; r < repeat; r ++) {
+     ArrayInitialize(historyProfit, 0.0);
+     ulong t = GetMicrosecondCount();
+     CheckOrders();
+     BenchAdd(GetMicrosecondCount() - t);
+   }
+   BenchWrite("orders", history, open, snapTotal);
+   isSleeping = sleeping;
+   ArrayCopy(historyProfit, profit);
+
+   BenchReset();
+   for(int r = 0; r < repeat; r ++) {
+     ulong t = GetMicrosecondCount();
+     CheckHistoryOrders();
+     BenchAdd(GetMicrosecondCount() - t);
+   }
+   BenchWrite("history", history, open, 0);
+
+   BenchReset();
+   for(int r = 0; r < MathMax(BENCH_REBUILD_REPEAT, 1); r ++) {
+     historyLastTicket = -2; // 对不上号，下一次整体重算
+     ulong t = GetMicrosecondCount();
+     CheckHistoryOrders();
+     BenchAdd(GetMicrosecondCount() - t);
+   }
+   BenchWrite("historyRebuild", history, open, history);
+
+   int total = OrdersTotal();
+   BenchReset();
+   ulong t = GetMicrosecondCount();
+   int left = CloseBasket(CLOSE_ALL, eaSymbol);
+   BenchAdd(GetMicrosecondCount() - t);
+   BenchWrite("close", history, open, total);
+   if(left > 0) {
+     Print("bench close left ", left, " orders");
+     return false;
+   }
+   CheckHistoryOrders();
+   return true;
+}
+
+// 造n单，单号放在benchTickets。current为false按轮次和层数造历史单；为true造持仓，每个方向只有当前一轮
+bool OpenBenchOrders(int n, bool current) {
+   ArrayResize(benchTickets, n, 64);
+   benchTicketTotal = 0;
+   int orders = MathMax(BENCH_CYCLE_ORDERS, 1);
+   int currentCycle = (benchSeq / orders + 1) & MAGIC_CYCLE_MASK; // 接在已经造的历史单后面
+   for(int i = 0; i < n; i ++) {
+     int cycle = currentCycle;
+     int level = MathMin(i / MATIN_DIRS, MAGIC_LEVEL_MASK);
+     int d = i % MATIN_DIRS;
+     if(!current) {
+       cycle = (benchSeq / orders) & MAGIC_CYCLE_MASK;
+       level = benchSeq % orders;
+       benchSeq ++;
+       d = cycle % MATIN_DIRS;
+     }
+#ifdef MATIN_DUAL
+     int type = d;
+#else
+     int type = cycle % 2; // 单马丁每轮随机方向，这里轮流
+#endif
+     int magic = 0;
+     string comment = "";
+     if(MathRand() % 100 < BENCH_OTHER_PCT) {
+       if(MathRand() % 2 == 0) magic = ((EA_ID + 1) & MAGIC_EA_MASK) << MAGIC_EA_SHIFT | level; // 其他EA，magic=0且没有comment的是手动单
+     } else {
+       bool legacy = MathRand() % 100 < BENCH_LEGACY_PCT;
+       if(level == 0) {
+         magic = legacy ? 0 : MakeMagic(d, cycle, 0, true);
+         comment = divideComment[d] + eaSymbol;
+       } else {
+         magic = legacy ? 0 : MakeMagic(type, cycle, level, false);
+         comment = (level == 1 ? firstComment[d] : levelComment[d] + IntegerToString(level) + "_") + eaSymbol;
+       }
+     }
+     int ticket = OrderSend(eaSymbol, type, MINI_LOT, type == OP_BUY ? Ask : Bid, 3, 0, 0, comment, magic);
+     if(ticket < 0) {
+       Print("bench send failed after ", benchSeq, " orders, error=", GetLastError());
+       return false;
+     }
+     benchTickets[benchTicketTotal] = ticket;
+     benchTicketTotal ++;
+   }
+   return true;
+}
+
+void ParseSizes(string text, int &sizes[]) {
+   string parts[];
+   int count = StringSplit(text, ',', parts);
+   ArrayResize(sizes, 0);
+   for(int i = 0; i < count; i ++) {
+     int size = (int)StringToInteger(parts[i]);
+     if(size < 0) continue;
+     int n = ArraySize(sizes);
+     ArrayResize(sizes, n + 1);
+     sizes[n] = size;
+   }
+   ArraySort(sizes); // 历史单只能越来越多，从小到大造
+}
+
+void BenchReset() {
+   benchSampleTotal = 0;
+}
+
+void BenchAdd(ulong micros) {
+   if(ArraySize(benchSamples) <= benchSampleTotal) {
+     ArrayResize(benchSamples, benchSampleTotal + 1, 256);
+   }
+   benchSamples[benchSampleTotal] = (double)micros;
+   benchSampleTotal ++;
+}
+
+// 一个环节一行，同时打印到日志
+void BenchWrite(string routine, int history, int open, int items) {
+   if(benchSampleTotal == 0) return;
+   double sum = 0;
+   for(int i = 0; i < benchSampleTotal; i ++) {
+     sum += benchSamples[i];
+   }
+   ArraySort(benchSamples, benchSampleTotal, 0, MODE_ASCEND);
+   double avg = sum / benchSampleTotal;
+   double p50 = benchSamples[(int)MathFloor((benchSampleTotal - 1) * 0.5)];
+   double p99 = benchSamples[(int)MathFloor((benchSampleTotal - 1) * 0.99)];
+   double maxUs = benchSamples[benchSampleTotal - 1];
+   double perSec = avg > 0 ? items * 1000000.0 / avg : 0;
+   string line = BENCH_LABEL + "," + IntegerToString(MATIN_DIRS) + "," + IntegerToString(history) + "," + IntegerToString(open) + "," + routine
+     + "," + IntegerToString(benchSampleTotal) + "," + IntegerToString(items) + "," + DoubleToStr(avg, 1) + "," + DoubleToStr(p50, 0)
+     + "," + DoubleToStr(p99, 0) + "," + DoubleToStr(maxUs, 0) + "," + DoubleToStr(perSec, 0);
+   FileWriteString(benchHandle, line + "\r\n");
+   Print("bench ", line);
+}
@@ -0,0 +1,410 @@
+//+------------------------------------------------------------------+
+//|                                                mt4-tickstore.mq4 |
+//|                        Copyright 2021, MetaQuotes Software Corp. |
+//|                                             https://www.mql5.com |
+//+------------------------------------------------------------------+
+#property strict
+#property script_show_inputs
+
+/*
+tick压缩存储脚本
+
+ CSV转二进制：每个块最多BLOCK_TICKS个tick，块内按列存（时间、bid、点差），
+ 每列第一个值原样存，后面存差值，差值用zigzag+varint压缩。文件最后是块索引（块首时间、偏移、数量）
+
+ 支持两种CSV（放在MQL4/Files下）：
+  时间,bid,ask                例: 2021.01.04 00:00:01.250,1.22345,1.22360
+  日期,时间,bid,ask            MT4导出格式，例: 2021.01.04,00:00:01,1.22345,1.22360
+
+ 文件格式：
+  头(32字节): magic | 版本 | digits | 每块tick数 | 块数 | 索引偏移(long) | 保留
+  块: 数量 | 首时间(毫秒,long) | 首bid(点,long) | 首点差(点,long) | 三列字节数 | 时间列 | bid列 | 点差列
+  索引: 每块 首时间(long) | 偏移(long) | 数量(int)
+
+ 按时间查找用索引二分，O(log n)；顺序扫描每次读整块再解码
+ **/
+
+input int TICKSTORE_MODE = 0; // 0:CSV转换 1:扫描测速 2:按时间查找
+input string CSV_FILE = "EURUSD_ticks.csv"; // 源CSV文件
+input string STORE_FILE = "EURUSD.tks"; // 压缩后的文件
+input int PRICE_DIGITS = 5; // 价格小数位
+input int BLOCK_TICKS = 4096; // 每块tick数
+input datetime SEEK_TIME = D'2021.01.04 00:00'; // 查找哪个时间
+
+#define TKS_MAGIC 0x31534B54 // "TKS1"
+#define TKS_VERSION 1
+#define TKS_HEADER_SIZE 32
+
+// 读取用的索引
+int storeDigits = 0;
+int storeBlockTicks = 0;
+int storeBlocks = 0;
+long idxTime[];
+long idxOffset[];
+int idxCount[];
+
+// 当前解码出来的块
+int blockTotal = 0;
+long blockTime[];
+double blockBid[];
+double blockAsk[];
+uchar blockBuf[];
+int badBlocks = 0; // 读不完整或者块头不对的块，扫描时跳过，结尾一起报
+
+void OnStart()
+  {
+   if(TICKSTORE_MODE == 0) {
+     ConvertCsv(CSV_FILE, STORE_FILE);
+   } else if(TICKSTORE_MODE == 1) {
+     ScanStore(STORE_FILE);
+   } else if(TICKSTORE_MODE == 2) {
+     SeekStore(STORE_FILE, (long)SEEK_TIME * 1000);
+   }
+  }
+
+//+--------------------------varint编码-------------------------------------------+
+int PutVarint(uchar &buf[], int pos, long v) {
+   ulong z = v >= 0 ? ((ulong)v << 1) : ((((ulong)(-(v + 1))) << 1) | 1);
+   if(ArraySize(buf) < pos + 10) {
+     ArrayResize(buf, pos + 10, 4096);
+   }
+   while(z >= 0x80) {
+     buf[pos++] = (uchar)(z | 0x80);
+     z >>= 7;
+   }
+   buf[pos++] = (uchar)z;
+   return pos;
+}
+
+// 只读到end为止，最多10个字节；读过了这一列的结尾或者超过10个字节返回false，块是坏的
+bool GetVarint(const uchar &buf[], int &pos, int end, long &value) {
+   ulong z = 0;
+   int shift = 0;
+   uchar b = 0;
+   do {
+     if(pos >= end || shift >= 70) return false;
+     b = buf[pos++];
+     z |= ((ulong)(b & 0x7F)) << shift;
+     shift += 7;
+   } while((b & 0x80) != 0);
+   if((z & 1) != 0) {
+     value = -(long)(z >> 1) - 1;
+   } else {
+     value = (long)(z >> 1);
+   }
+   return true;
+}
+
+//+--------------------------CSV转换-------------------------------------------+
+// "2021.01.04 00:00:01.250" 转成毫秒
+long ParseTickTime(string text) {
+   int dot = StringFind(text, ".", 11); // 跳过日期里的点
+   long ms = 0;
+   if(dot > 0) {
+     ms = StringToInteger(StringSubstr(text, dot + 1, 3));
+     text = StringSubstr(text, 0, dot);
+   }
+   return (long)StringToTime(text) * 1000 + ms;
+}
+
+void ConvertCsv(string csvFile, string storeFile) {
+   int csv = FileOpen(csvFile, FILE_READ | FILE_CSV | FILE_ANSI, ',');
+   if(csv == INVALID_HANDLE) {
+     Print("open ", csvFile, " failed, error=", GetLastError());
+     return;
+   }
+   int out = FileOpen(storeFile, FILE_WRITE | FILE_BIN);
+   if(out == INVALID_HANDLE) {
+     Print("open ", storeFile, " failed, error=", GetLastError());
+     FileClose(csv);
+     return;
+   }
+   WriteHeader(out, 0, 0);
+
+   double scale = MathPow(10, PRICE_DIGITS);
+   long times[];
+   long bids[];
+   long spreads[];
+   ArrayResize(times, BLOCK_TICKS);
+   ArrayResize(bids, BLOCK_TICKS);
+   ArrayResize(spreads, BLOCK_TICKS);
+   int n = 0;
+   int blocks = 0;
+   long ticks = 0;
+   long lastTime = 0;
+   long clamped = 0; // 时间比上一个tick早、被改成上一个tick时间的条数，这些tick还原不回原始数据
+   long maxBack = 0; // 最多倒退了多少毫秒
+   ulong startMicros = GetMicrosecondCount();
+
+   while(!FileIsEnding(csv)) {
+     string fields[4];
+     int cols = 0;
+     do {
+       string field = FileReadString(csv);
+       if(cols < 4) fields[cols] = field;
+       cols ++;
+     } while(!FileIsLineEnding(csv) && !FileIsEnding(csv));
+
+     long tickTime = 0;
+     double bid = 0;
+     double ask = 0;
+     if(cols == 3) {
+       tickTime = ParseTickTime(fields[0]);
+       bid = StringToDouble(fields[1]);
+       ask = StringToDouble(fields[2]);
+     } else if(cols >= 4) { // MT4导出: 日期,时间,bid,ask
+       tickTime = ParseTickTime(fields[0] + " " + fields[1]);
+       bid = StringToDouble(fields[2]);
+       ask = StringToDouble(fields[3]);
+     }
+     if(tickTime <= 0 || bid <= 0 || ask <= 0) continue; // 表头或坏行
+     if(tickTime < lastTime) { // 保证时间不倒退，二分才成立
+       if(clamped == 0) Print(csvFile, ": tick time goes back at ", TimeToStr((datetime)(tickTime / 1000), TIME_DATE | TIME_SECONDS), ", clamped to the previous tick");
+       clamped ++;
+       if(lastTime - tickTime > maxBack) maxBack = lastTime - tickTime;
+       tickTime = lastTime;
+     }
+     lastTime = tickTime;
+
+     times[n] = tickTime;
+     bids[n] = (long)MathRound(bid * scale);
+     spreads[n] = (long)MathRound(ask * scale) - bids[n];
+     n ++;
+     ticks ++;
+     if(n == BLOCK_TICKS) {
+       WriteBlock(out, times, bids, spreads, n);
+       blocks ++;
+       n = 0;
+     }
+   }
+   if(n > 0) {
+     WriteBlock(out, times, bids, spreads, n);
+     blocks ++;
+   }
+
+   long indexOffset = (long)FileTell(out);
+   for(int i = 0; i < ArraySize(idxTime); i ++) {
+     FileWriteLong(out, idxTime[i]);
+     FileWriteLong(out, idxOffset[i]);
+     FileWriteInteger(out, idxCount[i], INT_VALUE);
+   }
+   FileSeek(out, 0, SEEK_SET);
+   WriteHeader(out, blocks, indexOffset);
+   long size = (long)FileSize(out);
+   FileClose(out);
+   FileClose(csv);
+   Print(storeFile, ": ticks=", ticks, ", blocks=", blocks, ", bytes=", size,
+         ", bytes/tick=", ticks > 0 ? DoubleToStr((double)size / ticks, 2) : "0",
+         ", cost=", DoubleToStr((GetMicrosecondCount() - startMicros) / 1000000.0, 2), "s");
+   if(clamped > 0) {
+     Print(storeFile, ": ", clamped, " ticks out of order were clamped (max ", maxBack, "ms back), their times differ from ", csvFile);
+   }
+}
+
+void WriteHeader(int handle, int blocks, long indexOffset) {
+   FileWriteInteger(handle, TKS_MAGIC, INT_VALUE);
+   FileWriteInteger(handle, TKS_VERSION, INT_VALUE);
+   FileWriteInteger(handle, PRICE_DIGITS, INT_VALUE);
+   FileWriteInteger(handle, BLOCK_TICKS, INT_VALUE);
+   FileWriteInteger(handle, blocks, INT_VALUE);
+   FileWriteLong(handle, indexOffset);
+   FileWriteInteger(handle, 0, INT_VALUE);
+}
+
+// 一个块按列写：时间列、bid列、点差列各自差值编码
+void WriteBlock(int handle, const long &times[], const long &bids[], const long &spreads[], int n) {
+   uchar colTime[];
+   uchar colBid[];
+   uchar colSpread[];
+   int lenTime = 0;
+   int lenBid = 0;
+   int lenSpread = 0;
+   for(int i = 1; i < n; i ++) {
+     lenTime = PutVarint(colTime, lenTime, times[i] - times[i - 1]);
+     lenBid = PutVarint(colBid, lenBid, bids[i] - bids[i - 1]);
+     lenSpread = PutVarint(colSpread, lenSpread, spreads[i] - spreads[i - 1]);
+   }
+
+   int k = ArraySize(idxTime);
+   ArrayResize(idxTime, k + 1, 1024);
+   ArrayResize(idxOffset, k + 1, 1024);
+   ArrayResize(idxCount, k + 1, 1024);
+   idxTime[k] = times[0];
+   idxOffset[k] = (long)FileTell(handle);
+   idxCount[k] = n;
+
+   FileWriteInteger(handle, n, INT_VALUE);
+   FileWriteLong(handle, times[0]);
+   FileWriteLong(handle, bids[0]);
+   FileWriteLong(handle, spreads[0]);
+   FileWriteInteger(handle, lenTime, INT_VALUE);
+   FileWriteInteger(handle, lenBid, INT_VALUE);
+   FileWriteInteger(handle, lenSpread, INT_VALUE);
+   if(lenTime > 0) FileWriteArray(handle, colTime, 0, lenTime);
+   if(lenBid > 0) FileWriteArray(handle, colBid, 0, lenBid);
+   if(lenSpread > 0) FileWriteArray(handle, colSpread, 0, lenSpread);
+}
+
+//+--------------------------读取-------------------------------------------+
+int OpenStore(string storeFile) {
+   int handle = FileOpen(storeFile, FILE_READ | FILE_BIN | FILE_SHARE_READ);
+   if(handle == INVALID_HANDLE) {
+     Print("open ", storeFile, " failed, error=", GetLastError());
+     return INVALID_HANDLE;
+   }
+   if(FileReadInteger(handle, INT_VALUE) != TKS_MAGIC || FileReadInteger(handle, INT_VALUE) != TKS_VERSION) {
+     Print(storeFile, " is not a tick store");
+     FileClose(handle);
+     return INVALID_HANDLE;
+   }
+   storeDigits = FileReadInteger(handle, INT_VALUE);
+   storeBlockTicks = FileReadInteger(handle, INT_VALUE);
+   storeBlocks = FileReadInteger(handle, INT_VALUE);
+   long indexOffset = FileReadLong(handle);
+
+   ArrayResize(idxTime, storeBlocks);
+   ArrayResize(idxOffset, storeBlocks);
+   ArrayResize(idxCount, storeBlocks);
+   FileSeek(handle, indexOffset, SEEK_SET);
+   for(int i = 0; i < storeBlocks; i ++) {
+     idxTime[i] = FileReadLong(handle);
+     idxOffset[i] = FileReadLong(handle);
+     idxCount[i] = FileReadInteger(handle, INT_VALUE);
+   }
+   ArrayResize(blockTime, storeBlockTicks);
+   ArrayResize(blockBid, storeBlockTicks);
+   ArrayResize(blockAsk, storeBlockTicks);
+   badBlocks = 0;
+   return handle;
+}
+
+// 最后一个首时间<=t的块，t早于第一块时返回0
+int FindBlock(long t) {
+   int lo = 0;
+   int hi = storeBlocks - 1;
+   int found = 0;
+   while(lo <= hi) {
+     int mid = (lo + hi) / 2;
+     if(idxTime[mid] <= t) {
+       found = mid;
+       lo = mid + 1;
+     } else {
+       hi = mid - 1;
+     }
+   }
+   return found;
+}
+
+// 读整块再解码到blockTime/blockBid/blockAsk，返回tick数
+int ReadBlock(int handle, int block) {
+   blockTotal = 0;
+   FileSeek(handle, idxOffset[block], SEEK_SET);
+   int n = FileReadInteger(handle, INT_VALUE);
+   long t = FileReadLong(handle);
+   long bid = FileReadLong(handle);
+   long spread = FileReadLong(handle);
+   int lenTime = FileReadInteger(handle, INT_VALUE);
+   int lenBid = FileReadInteger(handle, INT_VALUE);
+   int lenSpread = FileReadInteger(handle, INT_VALUE);
+   int bytes = lenTime + lenBid + lenSpread;
+   if(n < 0 || n > storeBlockTicks || lenTime < 0 || lenBid < 0 || lenSpread < 0) {
+     badBlocks ++;
+     return 0;
+   }
+   if(ArraySize(blockBuf) < bytes) {
+     ArrayResize(blockBuf, bytes);
+   }
+   if(bytes > 0 && FileReadArray(handle, blockBuf, 0, bytes) != bytes) { // 文件被截断
+     badBlocks ++;
+     return 0;
+   }
+
+   double point = 1.0 / MathPow(10, storeDigits);
+   int posTime = 0;
+   int posBid = lenTime;
+   int posSpread = lenTime + lenBid;
+   int endTime = lenTime;
+   int endBid = lenTime + lenBid;
+   long dt = 0;
+   long dbid = 0;
+   long dspread = 0;
+   for(int i = 0; i < n; i ++) {
+     if(i > 0) {
+       if(!GetVarint(blockBuf, posTime, endTime, dt) || !GetVarint(blockBuf, posBid, endBid, dbid) || !GetVarint(blockBuf, posSpread, bytes, dspread)) {
+         badBlocks ++; // 块头的tick数和数据对不上
+         return 0;
+       }
+       t += dt;
+       bid += dbid;
+       spread += dspread;
+     }
+     blockTime[i] = t;
+     blockBid[i] = bid * point;
+     blockAsk[i] = (bid + spread) * point;
+   }
+   blockTotal = n;
+   return n;
+}
+
+void ScanStore(string storeFile) {
+   int handle = OpenStore(storeFile);
+   if(handle == INVALID_HANDLE) return;
+   ulong startMicros = GetMicrosecondCount();
+   long ticks = 0;
+   double checksum = 0;
+   for(int b = 0; b < storeBlocks; b ++) {
+     int n = ReadBlock(handle, b);
+     for(int i = 0; i < n; i ++) {
+       checksum += blockAsk[i] - blockBid[i];
+     }
+     ticks += n;
+   }
+   long size = (long)FileSize(handle);
+   FileClose(handle);
+   double seconds = (GetMicrosecondCount() - startMicros) / 1000000.0;
+   if(seconds <= 0) seconds = 0.000001;
+   Print(storeFile, ": ticks=", ticks, ", ", DoubleToStr(seconds, 3), "s, ",
+         DoubleToStr(ticks / seconds, 0), " ticks/s, ", DoubleToStr(size / seconds / 1048576.0, 1), " MB/s",
+         ", avg spread=", ticks > 0 ? DoubleToStr(checksum / ticks, storeDigits + 1) : "0");
+   if(badBlocks > 0) {
+     Print(storeFile, ": ", badBlocks, " of ", storeBlocks, " blocks are truncated or corrupt and were skipped");
+   }
+}
+
+void SeekStore(string storeFile, long t) {
+   int handle = OpenStore(storeFile);
+   if(handle == INVALID_HANDLE) return;
+   if(storeBlocks == 0) {
+     FileClose(handle);
+     return;
+   }
+   int block = FindBlock(t);
+   int n = ReadBlock(handle, block);
+   if(n == 0) {
+     Print(storeFile, ": block ", block, " is truncated or corrupt");
+     FileClose(handle);
+     return;
+   }
+   int i = 0;
+   while(i < n - 1 && blockTime[i] < t) i ++;
+   if(blockTime[i] < t) { // t在这一块最后一个tick之后，要的是下一块的第一个tick
+     if(block + 1 >= storeBlocks) {
+       Print("seek ", TimeToStr((datetime)(t / 1000), TIME_DATE | TIME_SECONDS), ": past end of store, last tick at ",
+             TimeToStr((datetime)(blockTime[i] / 1000), TIME_DATE | TIME_SECONDS));
+       FileClose(handle);
+       return;
+     }
+     block ++;
+     n = ReadBlock(handle, block);
+     if(n == 0) {
+       Print(storeFile, ": block ", block, " is truncated or corrupt");
+       FileClose(handle);
+       return;
+     }
+     i = 0;
+   }
+   Print("seek ", TimeToStr((datetime)(t / 1000), TIME_DATE | TIME_SECONDS), ": block=", block, "/", storeBlocks,
+         ", tick time=", TimeToStr((datetime)(blockTime[i] / 1000), TIME_DATE | TIME_SECONDS),
+         ", bid=", DoubleToStr(blockBid[i], storeDigits), ", ask=", DoubleToStr(blockAsk[i], storeDigits));
+   FileClose(handle);
+}
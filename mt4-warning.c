@@ -4,6 +4,31 @@
 //|                                             https://www.mql5.com |
 //+------------------------------------------------------------------+
 #property strict
+// 日志和性能分析在mt4-log.mqh，这里定义本EA的key和阶段，mt4-accountbus.mqh里也用，要先定义
+// 每条日志一个key，不同的日志互不影响
+#define LOG_KEY_STATUS 0
+#define LOG_KEY_DAYS 1
+#define LOG_KEY_MODIFY 2
+#define LOG_KEY_MAIL_SENT 3
+#define LOG_KEY_MAIL_RETRY 4
+#define LOG_KEY_BUS 5
+#define LOG_KEY_TOTAL 6
+#define LOG_DIRS 1
+string logKeyName[LOG_KEY_TOTAL] = {"status", "days", "modify", "mailSent", "mailRetry", "bus"};
+#define PROF_TICK 0
+#define PROF_DAYS 1
+#define PROF_BALANCE 2
+#define PROF_FLOAT 3
+#define PROF_RANGE 4
+#define PROF_STATUS 5
+#define PROF_OUTBOX 6
+#define PROF_FLUSH 7
+#define PROF_MODIFY 8
+#define PROF_STAGES 9
+string profName[PROF_STAGES] = {"tick", "days", "balance", "floatProfit", "rangeReport", "statusLog", "outbox", "flushLog", "modifyOrder"};
+#define PROF_FILE_DEFAULT "warning-profile.csv"
+#include "mt4-log.mqh"
+#include "mt4-accountbus.mqh" // 余额、浮动盈亏从马丁EA发布的账户快照里取，不用每个tick都问终端
 //+------------------------------------------------------------------+
 //| Expert initialization function                                   |
 //+------------------------------------------------------------------+
@@ -32,10 +57,90 @@ int SL_GOLD_POINT = 55; // 黄金止损点数
 int AUTO_CHANGE_SLED = 1; // 是否改动已经设置的止损
 string CLOSE_SIGNAL = "AUSUSD"; // 平仓品种信号
 
+// 止损距离表：品种 -> point、digits、止损离开仓价多远。OnInit给市场报价里的品种建好，遇到新品种再补一条
+// 规则按品种名关键字匹配，配置文件里的在前，内置的在后。配置文件每行: 关键字,止损点数[,每点价格]，#开头是注释，
+// 每点价格不写就按digits推(3、5位小数是point*10，否则是point)
+input bool AUTO_STOP_LOSS = false; // 是否按止损距离表给没设止损的单(AUTO_CHANGE_SLED时还有止损太远的单)设止损
+input string STOP_CONFIG_FILE = "warning-stops.csv"; // Files目录，不存在就只用内置规则
+int stopRuleTotal = 0;
+string stopRuleKey[];
+double stopRulePoints[];
+double stopRulePip[]; // 每点多少价格，0表示按digits推
+int stopTotal = 0;
+int stopLastHit = 0; // 上一单查到的品种，同品种的单一般挨着
+string stopSymbol[];
+double stopPoint[];
+int stopDigits[];
+double stopDistance[]; // 0表示这个品种不设止损
+
+// 止损跟踪：记下每单处理过后的止损，之后只看新单和止损被手动改过的单；改失败的按退避重试，不每个tick都去报
+// 持仓和历史单数量都没变、没有到期的重试、也不到复查时间时，modifyOrder直接返回。只有AUTO_STOP_LOSS打开才跑，
+// 退出时打印调用了几次、真正扫了几遍持仓、报了几次OrderModify，看常态下是不是都直接返回了
+input int MODIFY_RECHECK_SEC = 5; // AUTO_CHANGE_SLED打开时多少秒扫一遍手动改过的止损
+input int MODIFY_RETRY_SEC = 10; // 改止损失败第一次等多少秒重试，之后每次翻倍，最多64倍
+int trackTotal = 0;
+int trackTicket[]; // 按单号从小到大
+double trackStop[]; // 处理过后的止损，单子的止损还是这个就不用再看
+int trackFails[]; // 连续失败次数
+datetime trackNextTry[]; // 失败后下次重试时间，0表示不用重试
+int trackGen[]; // 最后一次在持仓里看到它是第几遍扫描，用来删掉已经平掉的单
+int trackGeneration = 0;
+int trackOrders = -1; // 上次扫描时的持仓数量
+int trackHistory = -1; // 上次扫描时的历史单数量
+datetime trackRecheckTime = 0;
+datetime trackRetryTime = 0; // 最早一个到期的重试，0表示没有
+ulong trackCalls = 0;
+ulong trackScans = 0;
+ulong trackModifies = 0;
+
+// 日线高低报告：每个品种缓存最近RANGE_DAYS根日线，环形存放，发报告时只补新出来的几根
+input string RANGE_SYMBOLS = "GOLDmicro"; // 报告哪些品种，逗号分隔
+input int RANGE_DAYS = 45; // 报告最近多少天
+input string RANGE_CSV_FILE = "range-report.csv"; // 同时写一份csv到Files目录，空表示不写
+int rangeTotal = 0;
+int rangeDays = 45;
+string rangeSymbol[];
+int rangeDigits[];
+int rangeHead[]; // 最新一根在环形里的位置
+int rangeCount[]; // 已经缓存了几根
+datetime rangeLastTime[]; // 上次缓存时最新一根的开盘时间
+// 品种s第k新的一根在 s*rangeDays + (rangeHead[s]+k)%rangeDays
+datetime rangeTime[];
+double rangeHigh[];
+double rangeLow[];
+datetime copyTime[]; // CopyTime/CopyHigh/CopyLow的缓冲，下标0是最新一根
+double copyHigh[];
+double copyLow[];
+string rangeText = "";
+
+// 邮件发件箱：OnTick只把提醒放进队列，OnTimer按预算发送。同类提醒在窗口内合并成一封，发送失败按退避重试
+// 测试时可以在终端的邮箱设置里把SMTP服务器指到本机的假SMTP服务，或者打开OUTBOX_DRY_RUN只写文件
+#define OUTBOX_SIZE 32
+#define ALERT_BALANCE 0
+#define ALERT_FLOAT_PROFIT 1
+#define ALERT_RANGE 2
+input int OUTBOX_COALESCE_SEC = 60; // 同类提醒多少秒内合并成一封
+input int OUTBOX_SEND_BUDGET = 1; // 每次OnTimer最多发几封
+input int OUTBOX_RETRY_SEC = 30; // 发送失败第一次等多少秒重试，之后每次翻倍
+input int OUTBOX_MAX_TRIES = 5; // 最多发几次，还失败就丢掉
+input bool OUTBOX_DRY_RUN = false; // 不真发，追加到Files目录的outbox.log
+bool outUsed[OUTBOX_SIZE];
+int outType[OUTBOX_SIZE];
+datetime outQueued[OUTBOX_SIZE]; // 第一条进队列的时间
+datetime outNextTime[OUTBOX_SIZE]; // 到这个时间才发
+int outTries[OUTBOX_SIZE];
+int outCount[OUTBOX_SIZE]; // 合并了几条
+string outSubject[OUTBOX_SIZE];
+string outBody[OUTBOX_SIZE];
+
 
 int OnInit()
   { 
-   
+   logLevel = LOG_LEVEL;
+   EventSetTimer(1);
+   BusInit();
+   InitRangeReport();
+   InitStopTable();
 
 //---
    return(INIT_SUCCEEDED);
@@ -47,8 +152,14 @@ int OnInit()
 //+------------------------------------------------------------------+
 void OnDeinit(const int reason)
   {
-//---
- 
+   EventKillTimer();
+   DumpProfile();
+   DrainOutbox(OUTBOX_SIZE, true); // 还在等合并或者重试的也发出去
+   if(AUTO_STOP_LOSS) {
+     Log("modifyOrder: calls=" + IntegerToString(trackCalls) + ", scans=" + IntegerToString(trackScans) + ", modifies=" + IntegerToString(trackModifies) + ", tracked=" + IntegerToString(trackTotal));
+   }
+   BusDeinit();
+   FlushLog();
   }
 /*------------------------------------------------------------------+
 提醒EA
@@ -57,33 +168,49 @@ void OnDeinit(const int reason)
 */
 void OnTick()
   {
-   double account = AccountInfoDouble(ACCOUNT_BALANCE);
+   BusAccount();
   // int total=OrdersTotal();
  
   // Print("Account #",AccountNumber(), " leverage is ",  AccountInfoInteger(ACCOUNT_LEVERAGE), " accountProfit=", AccountProfit());
   // int leverage = AccountLeverage();
   
 
+    ulong tickStart = ProfBegin();
+    ulong t = tickStart;
     PrintEARunningDays();
+    ProfEnd(PROF_DAYS, t);
     if(SEND_EMAIL == 1 && SEND_EMAIL_BALANCE == 1) {
+      t = ProfBegin();
       NoticeBalanceChanged();
+      ProfEnd(PROF_BALANCE, t);
     }
 
    if(SEND_EMAIL == 1 && SEND_EMAIL_FLOAT_PROFIT == 1) {
+      t = ProfBegin();
       NoticeFloatProfit();
+      ProfEnd(PROF_FLOAT, t);
    }
    
-  //  modifyOrder();   
+   if(AUTO_STOP_LOSS) {
+      t = ProfBegin();
+      modifyOrder();
+      ProfEnd(PROF_MODIFY, t);
+   }
   //  CheckOrders();
 
     if( Hour() == 23 && Minute() == 50 && sentFlag == 0 && SEND_EMAIL == 1 && SEND_EMAIL_GOLD == 1) { // 早上5点发送邮件
+      t = ProfBegin();
       SendGoldHighAndLow();
+      ProfEnd(PROF_RANGE, t);
       sentFlag = 1;
     }else if(Hour() != 23) {
       sentFlag = 0;
     } 
 
-    Print("Account #",AccountNumber(), ", accountProfit=", AccountProfit());
+    t = ProfBegin();
+    if(LogAllow(LOG_INFO, LOG_KEY_STATUS)) Log("Account #" + IntegerToString(AccountNumber()) + ", accountProfit=" + DoubleToStr(busHead.profit, 2));
+    ProfEnd(PROF_STATUS, t);
+    ProfEnd(PROF_TICK, tickStart);
   }
 
 //+------------------------------------------------------------------+
@@ -95,9 +222,6 @@ void CheckOrders(){
     {
     if(OrderSelect(pos,SELECT_BY_POS)==false) continue;
      string symbol = OrderSymbol();
-    // if(StringFind(symbol, CLOSE_SIGNAL) > -1) { // 手动平仓有时太慢了，自动平仓信号
-    //    CloseOrder("ALL");
-    // }
     floatProfit = floatProfit + OrderProfit();
     // double volume = OrderLots();
     // totalVolume = totalVolume + volume;
@@ -105,60 +229,145 @@ void CheckOrders(){
 }
 
 
-//+-----------------------开仓-------------------------------------------+
-void openOrder(string symbol, int orderType = 0, double volume = 0.01, double st = 0, double tp = 0, string comment = ""){
-    
-     // string symbol = Symbol();
-    //  int orderType = orderType; // 0:buy，1:sell
-     double openPrice = SymbolInfoDouble(symbol, SYMBOL_ASK);// 买价
-     if(orderType == 1) { // sell
-        openPrice = SymbolInfoDouble(symbol, SYMBOL_BID); // 卖价
-     }else if(orderType == 2) { // 挂单
-        openPrice = openPrice - 0.02;
+//+--------------------------止损距离表-------------------------------------------+
+void InitStopTable() {
+   stopRuleTotal = 0;
+   stopTotal = 0;
+   stopLastHit = 0;
+   LoadStopRules();
+   // 内置规则: 外汇、日元的pip填0，按品种的小数位算(3、5位是10个point)，4位、2位报价也对；黄金按0.1，BTC直接1000
+   AddStopRule("BTCUSD", 1000, 1);
+   AddStopRule("GBPUSD", SL_FOREX_POINT, 0);
+   AddStopRule("EURUSD", SL_FOREX_POINT, 0);
+   AddStopRule("EURGBP", SL_FOREX_POINT, 0);
+   AddStopRule("AUDCHF", SL_FOREX_POINT, 0);
+   AddStopRule("CAD", SL_FOREX_POINT, 0);
+   AddStopRule("JPY", SL_FOREX_POINT, 0);
+   AddStopRule("GOLD", SL_GOLD_POINT, 0.1);
+   AddStopRule("XAUUSD", SL_GOLD_POINT, 0.1);
+   int n = SymbolsTotal(true);
+   for(int i = 0; i < n; i ++) {
+     AddStopSymbol(SymbolName(i, true));
+   }
+}
+
+void LoadStopRules() {
+   if(STOP_CONFIG_FILE == "" || !FileIsExist(STOP_CONFIG_FILE)) return;
+   int handle = FileOpen(STOP_CONFIG_FILE, FILE_READ | FILE_TXT | FILE_ANSI);
+   if(handle == INVALID_HANDLE) {
+     Log("open " + STOP_CONFIG_FILE + " failed, error=" + IntegerToString(GetLastError()));
+     return;
+   }
+   while(!FileIsEnding(handle)) {
+     string line = FileReadString(handle);
+     StringTrimLeft(line);
+     StringTrimRight(line);
+     if(line == "" || StringGetCharacter(line, 0) == '#') continue;
+     string parts[];
+     int n = StringSplit(line, ',', parts);
+     for(int i = 0; i < n; i ++) {
+       StringTrimLeft(parts[i]);
+       StringTrimRight(parts[i]);
+     }
+     if(n < 2 || parts[0] == "") {
+       Log(STOP_CONFIG_FILE + ": bad line " + line);
+       continue;
      }
+     AddStopRule(parts[0], StringToDouble(parts[1]), n > 2 ? StringToDouble(parts[2]) : 0);
+   }
+   FileClose(handle);
+}
 
+void AddStopRule(string key, double points, double pip) {
+   ArrayResize(stopRuleKey, stopRuleTotal + 1, 16);
+   ArrayResize(stopRulePoints, stopRuleTotal + 1, 16);
+   ArrayResize(stopRulePip, stopRuleTotal + 1, 16);
+   stopRuleKey[stopRuleTotal] = key;
+   stopRulePoints[stopRuleTotal] = points;
+   stopRulePip[stopRuleTotal] = pip;
+   stopRuleTotal ++;
+}
 
-     bool res =  OrderSend(symbol, orderType, volume, openPrice, 30, st, tp, comment , 0, 0 );
-      if(!res)
-          Print("Error in OrderSend. Error code=",GetLastError());
-      else {
-          Print("OrderSend  successfully.");
-      }      
-    
+// 每单只查一次表，表里没有的品种按规则补一条
+int FindStopSymbol(string symbol) {
+   if(stopLastHit < stopTotal && stopSymbol[stopLastHit] == symbol) return stopLastHit;
+   for(int i = 0; i < stopTotal; i ++) {
+     if(stopSymbol[i] == symbol) {
+       stopLastHit = i;
+       return i;
+     }
+   }
+   stopLastHit = AddStopSymbol(symbol);
+   return stopLastHit;
+}
+
+int AddStopSymbol(string symbol) {
+   double point = MarketInfo(symbol, MODE_POINT);
+   int digits = (int)MarketInfo(symbol, MODE_DIGITS);
+   double distance = 0;
+   for(int r = 0; r < stopRuleTotal; r ++) {
+     if(StringFind(symbol, stopRuleKey[r]) == -1) continue;
+     double pip = stopRulePip[r];
+     if(pip == 0) {
+       pip = (digits == 3 || digits == 5) ? point * 10 : point;
+     }
+     distance = stopRulePoints[r] * pip;
+     break;
+   }
+   ArrayResize(stopSymbol, stopTotal + 1, 64);
+   ArrayResize(stopPoint, stopTotal + 1, 64);
+   ArrayResize(stopDigits, stopTotal + 1, 64);
+   ArrayResize(stopDistance, stopTotal + 1, 64);
+   stopSymbol[stopTotal] = symbol;
+   stopPoint[stopTotal] = point;
+   stopDigits[stopTotal] = digits;
+   stopDistance[stopTotal] = distance;
+   // 每个品种只查一次，不限频，不然同一分钟里查的别的品种会被吞掉
+   if(distance > 0 && logLevel <= LOG_INFO) Log("stop distance " + symbol + "=" + DoubleToStr(distance, digits));
+   stopTotal ++;
+   return stopTotal - 1;
 }
 
 //+------------------------------------------------------------------+
 void modifyOrder(){
  int total=OrdersTotal();
- if(total == 0) return;
-  // write open orders
+ datetime now = TimeCurrent();
+ bool changed = total != trackOrders || OrdersHistoryTotal() != trackHistory;
+ bool recheck = AUTO_CHANGE_SLED == 1 && now >= trackRecheckTime;
+ bool retry = trackRetryTime != 0 && now >= trackRetryTime;
+ trackCalls ++;
+ if(!changed && !recheck && !retry) return;
+ trackScans ++;
+ trackOrders = total;
+ trackHistory = OrdersHistoryTotal();
+ if(recheck) trackRecheckTime = now + MODIFY_RECHECK_SEC;
+ trackRetryTime = 0;
+ trackGeneration ++;
 
   for(int pos=0;pos<total;pos++)
     {
    if(OrderSelect(pos,SELECT_BY_POS)==false) continue;
-    // printf( OrderOpenPrice() +" " + OrderOpenTime() +" "  + OrderSymbol() +" " + OrderLots());
-     double TrailingStop=0;
-     string symbol = OrderSymbol();
-     double point = 1;
-    // printf(pos + ": symbol=" + symbol);
-    if(StringFind(symbol, "BTCUSD") > -1){
-         TrailingStop = 1000 ;
-     }else if(StringFind(symbol, "GBPUSD") > -1 || StringFind(symbol, "EURUSD") > -1){
-       TrailingStop = SL_FOREX_POINT * 0.0001; // 点数是倒数第一位；如果是倒数第二位，TrailingStop=1000
-     }else if(StringFind(symbol, "EURGBP") > -1 || StringFind(symbol, "AUDCHF") > -1 ){
-        TrailingStop = SL_FOREX_POINT * 0.0001;
-     }else if(StringFind(symbol, "CAD") > -1) {
-         TrailingStop = SL_FOREX_POINT * 0.0001;
-     }else if(StringFind(symbol, "JPY") > -1)
-     {
-         TrailingStop = SL_FOREX_POINT * 0.01;
-     } else if(StringFind(symbol, "GOLD") > -1 || StringFind(symbol, "XAUUSD") > -1) {
-        TrailingStop = SL_GOLD_POINT * 0.1;
-     } else {
-       continue; 
+     int ticket = OrderTicket();
+     int t = FindTrack(ticket);
+     if(t == trackTotal || trackTicket[t] != ticket) {
+       InsertTrack(t, ticket);
+     } else if(trackNextTry[t] == 0 && trackStop[t] == OrderStopLoss()) { // 处理过，止损也没被改过
+       trackGen[t] = trackGeneration;
+       continue;
      }
+     trackGen[t] = trackGeneration;
+     if(trackNextTry[t] > now) { // 还在退避
+       if(trackRetryTime == 0 || trackNextTry[t] < trackRetryTime) trackRetryTime = trackNextTry[t];
+       continue;
+     }
+     trackStop[t] = OrderStopLoss();
+     trackNextTry[t] = 0;
+
+     int k = FindStopSymbol(OrderSymbol());
+     double TrailingStop = stopDistance[k];
+     int digits = stopDigits[k];
+     if(TrailingStop == 0) continue;
 
-     // printf("OrderSymbol=" + OrderSymbol() + ",Point*TrailingStop=" + point*TrailingStop);
      int orderType = OrderType(); // 0:buy，1:sell
  
      double stopLoss = OrderOpenPrice() - TrailingStop;
@@ -169,11 +378,11 @@ void modifyOrder(){
 
      if(orderType == 1) {
        stopLoss = OrderOpenPrice() + TrailingStop;
-       if( NormalizeDouble(sl-stopLoss, 4) > 0) {
+       if( NormalizeDouble(sl-stopLoss, digits) > 0) {
        tooMuchStopLoss = true;
        }
      }else {
-       if(NormalizeDouble(sl-stopLoss, 4) < 0) {
+       if(NormalizeDouble(sl-stopLoss, digits) < 0) {
        tooMuchStopLoss = true;
        }
      }
@@ -183,59 +392,205 @@ void modifyOrder(){
      }
 
      if((OrderStopLoss() != 0 && tooMuchStopLoss == false)  || TrailingStop == 0 ) continue;
-     bool res=OrderModify(OrderTicket(),OrderOpenPrice(),stopLoss, OrderTakeProfit(),0);
-      if(!res)
-               Print("Error in OrderModify. Error code=",GetLastError());
-            else
-               Print("Order modified successfully.");
+     stopLoss = NormalizeDouble(stopLoss, digits);
+     trackModifies ++;
+     bool res=OrderModify(ticket,OrderOpenPrice(),stopLoss, OrderTakeProfit(),0);
+      if(!res) {
+               int error = GetLastError();
+               trackFails[t] ++;
+               trackNextTry[t] = now + MODIFY_RETRY_SEC * (1 << (int)MathMin(trackFails[t] - 1, 6));
+               if(trackRetryTime == 0 || trackNextTry[t] < trackRetryTime) trackRetryTime = trackNextTry[t];
+               Log("Error in OrderModify #" + IntegerToString(ticket) + ". Error code=" + IntegerToString(error) + ", retry in " + IntegerToString((int)(trackNextTry[t] - now)) + "s");
+      } else {
+               trackStop[t] = stopLoss;
+               trackFails[t] = 0;
+               if(LogAllow(LOG_INFO, LOG_KEY_MODIFY)) Log("Order modified successfully.");
+      }
     }
+  PruneTrack();
+}
+
+// 第一个单号不小于ticket的位置，二分
+int FindTrack(int ticket) {
+  int lo = 0;
+  int hi = trackTotal;
+  while(lo < hi) {
+    int mid = (lo + hi) / 2;
+    if(trackTicket[mid] < ticket) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// 新单号一般比已有的都大，直接接在后面
+void InsertTrack(int at, int ticket) {
+  ArrayResize(trackTicket, trackTotal + 1, 64);
+  ArrayResize(trackStop, trackTotal + 1, 64);
+  ArrayResize(trackFails, trackTotal + 1, 64);
+  ArrayResize(trackNextTry, trackTotal + 1, 64);
+  ArrayResize(trackGen, trackTotal + 1, 64);
+  for(int i = trackTotal; i > at; i --) {
+    trackTicket[i] = trackTicket[i - 1];
+    trackStop[i] = trackStop[i - 1];
+    trackFails[i] = trackFails[i - 1];
+    trackNextTry[i] = trackNextTry[i - 1];
+    trackGen[i] = trackGen[i - 1];
+  }
+  trackTicket[at] = ticket;
+  trackStop[at] = -1; // 还没处理过
+  trackFails[at] = 0;
+  trackNextTry[at] = 0;
+  trackGen[at] = trackGeneration;
+  trackTotal ++;
+}
+
+// 这一遍没看到的单已经平掉了
+void PruneTrack() {
+  int n = 0;
+  for(int i = 0; i < trackTotal; i ++) {
+    if(trackGen[i] != trackGeneration) continue;
+    trackTicket[n] = trackTicket[i];
+    trackStop[n] = trackStop[i];
+    trackFails[n] = trackFails[i];
+    trackNextTry[n] = trackNextTry[i];
+    trackGen[n] = trackGen[i];
+    n ++;
+  }
+  trackTotal = n;
 }
 
 void NoticeBalanceChanged() {
    // when the balance is change, notice me!
-    double account = AccountInfoDouble(ACCOUNT_BALANCE);
+    double account = busHead.balance;
     if(oldBalance != account) {
         if(MathAbs(account-oldBalance) < AMMOUNT_BALANCE_HINT) {
           return;
         }
         sendText = "The balance is changed: " + DoubleToStr(NormalizeDouble(account-oldBalance, 2), 2) + "\n\nNow your balance: " + account + "\n\njust follow the DAO";
        // SendNotification(sendText);
-        SendMail("账户余额变动",  sendText);
+        QueueAlert(ALERT_BALANCE, "账户余额变动",  sendText);
         oldBalance = account; 
     }
 }
 
 
 void NoticeFloatProfit() {
-  if(MathAbs(AccountProfit())  > MathAbs(FLOAT_PROFIT_HINT)  && sendFloatProfitNoticeFlag == false) {
-    sendText = "The float profit exceed the max, now the float profit is " + AccountProfit();
-    SendMail("浮动盈亏警告",  sendText);
+  if(MathAbs(busHead.profit)  > MathAbs(FLOAT_PROFIT_HINT)  && sendFloatProfitNoticeFlag == false) {
+    sendText = "The float profit exceed the max, now the float profit is " + DoubleToStr(busHead.profit, 2);
+    QueueAlert(ALERT_FLOAT_PROFIT, "浮动盈亏警告",  sendText);
     sendFloatProfitNoticeFlag = true;
   }
 }
 
+// 每个品种补一下缓存，再一次性拼成邮件正文。High[]/Low[]是图表品种的，不能用
 void SendGoldHighAndLow() {
-  // string symbol = Symbol();
-   string symbol = "GOLDmicro";
-   sendText = "";
-   double valHigh;
-   double valLow;
-  //  int val_index=iHighest(symbol, PERIOD_D1,MODE_HIGH,5,0);
-  //  if(val_index!=-1) val=High[val_index];
-  //  printf("val_index=" +  val_index + ", high=" + val);
-
-   for(int pos=0; pos< 45;pos++)
-    {
-     int val_index=iHighest(symbol, PERIOD_D1, MODE_HIGH, 1, pos);
-     if(val_index!=-1) valHigh=High[val_index];
-     int val_index2=iLowest(symbol, PERIOD_D1, MODE_LOW, 1, pos);
-    if(val_index2!=-1) valLow=Low[val_index2];
-     datetime barTime = iTime(symbol,PERIOD_D1, pos);
-     string barTimeStr = TimeToStr(barTime,TIME_DATE);
-     sendText = sendText + "\n\n" + barTimeStr + "_" + valHigh + "_" + valLow + ", 相差" + MathAbs( NormalizeDouble(valHigh-valLow, 2)) + "美金";
-    // printf("sendText=" + sendText );
-    }
-   SendMail("GOLD HIGH and LOW",  sendText);
+   rangeText = "";
+   int handle = INVALID_HANDLE;
+   if(RANGE_CSV_FILE != "") {
+     handle = FileOpen(RANGE_CSV_FILE, FILE_WRITE | FILE_CSV | FILE_ANSI, ',');
+     if(handle == INVALID_HANDLE) {
+       Log("open " + RANGE_CSV_FILE + " failed, error=" + IntegerToString(GetLastError()));
+     } else {
+       FileWrite(handle, "symbol", "date", "high", "low", "range");
+     }
+   }
+   for(int s = 0; s < rangeTotal; s ++) {
+     if(!RefreshRange(s)) {
+       Log("range " + rangeSymbol[s] + " not ready, error=" + IntegerToString(GetLastError()));
+       continue;
+     }
+     if(rangeTotal > 1) {
+       StringAdd(rangeText, "\n\n" + rangeSymbol[s]);
+     }
+     for(int k = 0; k < rangeCount[s]; k ++) {
+       int at = s * rangeDays + (rangeHead[s] + k) % rangeDays;
+       string date = TimeToStr(rangeTime[at], TIME_DATE);
+       string high = DoubleToStr(rangeHigh[at], rangeDigits[s]);
+       string low = DoubleToStr(rangeLow[at], rangeDigits[s]);
+       string diff = DoubleToStr(MathAbs(rangeHigh[at] - rangeLow[at]), 2);
+       StringAdd(rangeText, "\n\n" + date + "_" + high + "_" + low + ", 相差" + diff + "美金"); // 原地追加，不重新拷贝整段
+       if(handle != INVALID_HANDLE) {
+         FileWrite(handle, rangeSymbol[s], date, high, low, diff);
+       }
+     }
+   }
+   if(handle != INVALID_HANDLE) {
+     FileClose(handle);
+   }
+   QueueAlert(ALERT_RANGE, "GOLD HIGH and LOW",  rangeText);
+}
+
+void InitRangeReport() {
+   string parts[];
+   int n = StringSplit(RANGE_SYMBOLS, ',', parts);
+   rangeDays = MathMax(RANGE_DAYS, 1);
+   rangeTotal = 0;
+   ArrayResize(rangeSymbol, MathMax(n, 0));
+   ArrayResize(rangeDigits, MathMax(n, 0));
+   ArrayResize(rangeHead, MathMax(n, 0));
+   ArrayResize(rangeCount, MathMax(n, 0));
+   ArrayResize(rangeLastTime, MathMax(n, 0));
+   for(int i = 0; i < n; i ++) {
+     string symbol = parts[i];
+     StringTrimLeft(symbol);
+     StringTrimRight(symbol);
+     if(symbol == "") continue;
+     if(!SymbolSelect(symbol, true)) {
+       Log("range symbol " + symbol + " not found, error=" + IntegerToString(GetLastError()));
+       continue;
+     }
+     rangeSymbol[rangeTotal] = symbol;
+     rangeDigits[rangeTotal] = (int)MarketInfo(symbol, MODE_DIGITS);
+     rangeHead[rangeTotal] = 0;
+     rangeCount[rangeTotal] = 0;
+     rangeLastTime[rangeTotal] = 0;
+     rangeTotal ++;
+   }
+   ArrayResize(rangeTime, rangeTotal * rangeDays);
+   ArrayResize(rangeHigh, rangeTotal * rangeDays);
+   ArrayResize(rangeLow, rangeTotal * rangeDays);
+   ArraySetAsSeries(copyTime, true);
+   ArraySetAsSeries(copyHigh, true);
+   ArraySetAsSeries(copyLow, true);
+   for(int s = 0; s < rangeTotal; s ++) {
+     RefreshRange(s); // 顺便让终端先把日线下载下来
+   }
+}
+
+// 跟上次比只多了几根的话只取新的几根(加上之前最新那根，当时还没收盘)，否则整段重取
+bool RefreshRange(int s) {
+   string symbol = rangeSymbol[s];
+   datetime newest = iTime(symbol, PERIOD_D1, 0);
+   if(newest == 0) return false; // 日线还没下载好
+   int fetch = rangeDays;
+   bool full = true;
+   if(rangeCount[s] > 0) {
+     int shift = newest == rangeLastTime[s] ? 0 : iBarShift(symbol, PERIOD_D1, rangeLastTime[s], true);
+     if(shift >= 0 && shift < rangeDays - 1) {
+       fetch = shift + 1;
+       full = false;
+     }
+   }
+   int got = CopyTime(symbol, PERIOD_D1, 0, fetch, copyTime);
+   if(got <= 0 || CopyHigh(symbol, PERIOD_D1, 0, got, copyHigh) != got || CopyLow(symbol, PERIOD_D1, 0, got, copyLow) != got) {
+     return false;
+   }
+   if(full) {
+     rangeHead[s] = 0;
+     rangeCount[s] = got;
+   } else {
+     if(got < fetch) return false;
+     rangeHead[s] = (rangeHead[s] - (fetch - 1) + rangeDays) % rangeDays;
+     rangeCount[s] = MathMin(rangeCount[s] + fetch - 1, rangeDays);
+   }
+   for(int k = 0; k < got; k ++) {
+     int at = s * rangeDays + (rangeHead[s] + k) % rangeDays;
+     rangeTime[at] = copyTime[k];
+     rangeHigh[at] = copyHigh[k];
+     rangeLow[at] = copyLow[k];
+   }
+   rangeLastTime[s] = newest;
+   return true;
 }
 
 
@@ -246,62 +601,96 @@ void PrintEARunningDays() {
     } else if(Hour() != 2) {
       flag_EARunningDays = 0;
     }
-   Print("account#",  AccountNumber() , ", EA is runing ", EARunningDays + " days", ",AccountProfit=", AccountProfit());
+   if(LogAllow(LOG_INFO, LOG_KEY_DAYS)) Log("account#" + IntegerToString(AccountNumber()) + ", EA is runing " + DoubleToStr(EARunningDays, 0) + " days" + ",AccountProfit=" + DoubleToStr(busHead.profit, 2));
 }
 
 
-void CloseOrder(string closeType = "11111", ulong ticket = 10000, string symbol = "init")
-{
-   if(OrdersTotal() == 0) return ;
-   // Update the exchange rates before closing the orders.
-   RefreshRates();
-   // Log in the terminal the total of orders, current and past.
-   Print(OrdersTotal());
-      
-   // Start a loop to scan all the orders.
-   // The loop starts from the last order, proceeding backwards; Otherwise it would skip some orders.
-   for (int i = (OrdersTotal() - 1); i >= 0; i--)
-   {
-      // If the order cannot be selected, throw and log an error.
-      if (OrderSelect(i, SELECT_BY_POS, MODE_TRADES) == false)
-          {
-         Print("ERROR - Unable to select the order - ", GetLastError());
-         break;
-      } 
-
-
-      // Create the required variables.
-      // Result variable - to check if the operation is successful or not.
-      bool res = false;
-      
-      // Allowed Slippage - the difference between current price and close price.
-      int Slippage = 0;
-      int closeTicket = OrderTicket();
-      string orderSymbol = OrderSymbol();
-      if(closeType == "ALL") {
-        closeTicket = OrderTicket();
-      } else if (closeType == "PART" && closeTicket != ticket) {
+//+--------------------------发件箱-------------------------------------------+
+void QueueAlert(int type, string subject, string body) {
+   datetime now = TimeLocal(); // 周末没有报价TimeCurrent()不走
+   int free = -1;
+   for(int i = 0; i < OUTBOX_SIZE; i ++) {
+     if(!outUsed[i]) {
+       if(free == -1) free = i;
        continue;
-      }else if(closeType == "SYMBOL" && orderSymbol != symbol) {
-        continue;
-      }
-      // Bid and Ask prices for the instrument of the order.
-      double BidPrice = MarketInfo(orderSymbol, MODE_BID);
-      double AskPrice = MarketInfo(orderSymbol, MODE_ASK);
+     }
+     if(outType[i] == type && outTries[i] == 0 && now - outQueued[i] < OUTBOX_COALESCE_SEC) { // 还没发过，合并进去
+       StringAdd(outBody[i], "\n\n----------\n\n" + body);
+       outCount[i] ++;
+       return;
+     }
+   }
+   if(free == -1) {
+     Log("outbox full, drop mail " + subject);
+     return;
+   }
+   outUsed[free] = true;
+   outType[free] = type;
+   outQueued[free] = now;
+   outNextTime[free] = now + OUTBOX_COALESCE_SEC; // 等窗口结束，后面来的同类提醒一起发
+   outTries[free] = 0;
+   outCount[free] = 1;
+   outSubject[free] = subject;
+   outBody[free] = body;
+}
 
-      // double BidPrice = MarketInfo(OrderSymbol(), MODE_BID);
+void DrainOutbox(int budget, bool force = false) {
+   datetime now = TimeLocal();
+   for(int i = 0; i < OUTBOX_SIZE && budget > 0; i ++) {
+     if(!outUsed[i] || (!force && outNextTime[i] > now)) continue;
+     budget --;
+     string subject = outSubject[i];
+     if(outCount[i] > 1) {
+       subject = subject + " (" + IntegerToString(outCount[i]) + ")";
+     }
+     if(SendAlert(subject, outBody[i])) {
+       outUsed[i] = false;
+       outBody[i] = NULL;
+       if(LogAllow(LOG_INFO, LOG_KEY_MAIL_SENT)) Log("mail sent: " + subject);
+       continue;
+     }
+     outTries[i] ++;
+     if(outTries[i] >= OUTBOX_MAX_TRIES) {
+       Log("drop mail " + subject + " after " + IntegerToString(outTries[i]) + " tries, error=" + IntegerToString(GetLastError()));
+       outUsed[i] = false;
+       outBody[i] = NULL;
+       continue;
+     }
+     outNextTime[i] = now + OUTBOX_RETRY_SEC * (1 << MathMin(outTries[i] - 1, 10));
+     if(LogAllow(LOG_WARN, LOG_KEY_MAIL_RETRY)) Log("mail " + subject + " failed, retry in " + IntegerToString((int)(outNextTime[i] - now)) + "s, error=" + IntegerToString(GetLastError()));
+   }
+}
 
-      // Closing the order using the correct price depending on the type of order.
-      if (OrderType() == OP_BUY)
-          {
-         res = OrderClose(closeTicket, OrderLots(), BidPrice, Slippage);
-      }
-      else if (OrderType() == OP_SELL)
-          {
-         res = OrderClose(closeTicket, OrderLots(), AskPrice, Slippage);
-      }
-      
-      // If there was an error, log it.
-      if (res == false) Print("ERROR - Unable to close the order - ", OrderTicket(), " - ", GetLastError());
+bool SendAlert(string subject, string body) {
+   if(!OUTBOX_DRY_RUN) {
+     return SendMail(subject, body);
+   }
+   int handle = FileOpen("outbox.log", FILE_READ | FILE_WRITE | FILE_TXT | FILE_ANSI);
+   if(handle == INVALID_HANDLE) return false;
+   FileSeek(handle, 0, SEEK_END);
+   FileWriteString(handle, TimeToStr(TimeLocal(), TIME_DATE | TIME_SECONDS) + " " + subject + "\r\n" + body + "\r\n\r\n");
+   FileClose(handle);
+   return true;
+}
+
+//+--------------------------日志-------------------------------------------+
+// 只看本EA自己的图表，不分品种、方向，只有一行
+int LogRow() {
+   return 0;
+}
+
+string LogPrefix(int row, int d) {
+   return "";
+}
+
+void OnTimer() {
+   if(PROFILE && PROFILE_DUMP_SEC > 0 && TimeLocal() - profLastDump >= PROFILE_DUMP_SEC) {
+     DumpProfile();
    }
-}
\ No newline at end of file
+   ulong t = ProfBegin();
+   DrainOutbox(OUTBOX_SEND_BUDGET);
+   ProfEnd(PROF_OUTBOX, t);
+   t = ProfBegin();
+   FlushLog();
+   ProfEnd(PROF_FLUSH, t);
+}